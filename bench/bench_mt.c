@@ -0,0 +1,205 @@
+/**
+ * @brief: scaling benchmark, mutex + gn_string_concat against gn_string_mt_append,
+ *         every record carries its thread id and sequence number and the output is checked
+ *         to hold each producer's records exactly once and in order
+ *         build: cc -std=c11 -O2 -pthread -I.. bench_mt.c -o bench_mt
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "gn_string_mt.h"
+
+#define RECORDS_PER_THREAD 200000
+#define MAX_THREADS 16
+#define RECORD_FORMAT "tid=%02d seq=%08d level=info msg=\"request served\" status=200\n"
+#define SEQ_OFFSET 11 /* where the 8 digits of seq start in RECORD_FORMAT */
+#define SEQ_DIGITS 8
+
+static size_t record_length;
+static gn_string *locked_out;
+static pthread_mutex_t locked_mutex = PTHREAD_MUTEX_INITIALIZER;
+static gn_string_mt shared;
+static atomic_int producing;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static gn_string *record_new(int tid)
+{
+    gn_string *record = NULL;
+    gn_string_new_n(record, 128);
+    gn_string_printf(record, RECORD_FORMAT, tid, 0);
+    return record;
+}
+
+/**
+ * @brief:  rewrite the seq digits in place, cheaper than formatting the whole record again
+ */
+static void record_stamp(gn_string *record, int seq)
+{
+    for (int i = SEQ_OFFSET + SEQ_DIGITS - 1; i >= SEQ_OFFSET; --i)
+    {
+        record->_ptr[i] = '0' + seq % 10;
+        seq /= 10;
+    }
+}
+
+/**
+ * @brief:  an empty gn_string big enough for every record of the run, so neither side
+ *          reallocates and the table compares only the two ways of appending
+ */
+static gn_string *output_new(int threads)
+{
+    gn_string *out = NULL;
+    gn_string_new_n(out, (size_t)threads * RECORDS_PER_THREAD * record_length + 1);
+    return out;
+}
+
+/**
+ * @brief:  check that out holds RECORDS_PER_THREAD records of every thread, each once and in order
+ */
+static void verify(const gn_string *out, int threads)
+{
+    const char *pos = gn_string_to_str(out);
+    const char *end = pos + gn_string_len(out);
+    long last[MAX_THREADS];
+    gn_string *expect = record_new(0);
+    size_t length = gn_string_len(expect);
+
+    for (int i = 0; i < threads; ++i)
+    {
+        last[i] = -1;
+    }
+
+    for (; pos < end; pos += length)
+    {
+        long tid = strtol(pos + 4, NULL, 10);
+        long seq = strtol(pos + SEQ_OFFSET, NULL, 10);
+
+        /* compare everything but the two numbers against a record of the same tid and seq */
+        gn_string_clear(expect);
+        gn_string_printf(expect, RECORD_FORMAT, (int)tid, (int)seq);
+        if ((size_t)(end - pos) < length || tid < 0 || tid >= threads || seq != last[tid] + 1 ||
+            memcmp(pos, gn_string_to_str(expect), length))
+        {
+            fprintf(stderr, "bad record at byte %ld\n", (long)(pos - gn_string_to_str(out)));
+            FALSE_EXIT();
+        }
+        last[tid] = seq;
+    }
+
+    for (int i = 0; i < threads; ++i)
+    {
+        if (last[i] != RECORDS_PER_THREAD - 1)
+        {
+            fprintf(stderr, "thread %d wrote %ld records\n", i, last[i] + 1);
+            FALSE_EXIT();
+        }
+    }
+    gn_string_free(expect);
+}
+
+static void *run_locked(void *arg)
+{
+    gn_string *record = record_new((int)(intptr_t)arg);
+    for (int i = 0; i < RECORDS_PER_THREAD; ++i)
+    {
+        record_stamp(record, i);
+        pthread_mutex_lock(&locked_mutex);
+        gn_string_concat(locked_out, record);
+        pthread_mutex_unlock(&locked_mutex);
+    }
+    gn_string_free(record);
+    return NULL;
+}
+
+static void *run_shared(void *arg)
+{
+    gn_string *record = record_new((int)(intptr_t)arg);
+    for (int i = 0; i < RECORDS_PER_THREAD; ++i)
+    {
+        record_stamp(record, i);
+        gn_string_mt_concat(&shared, record);
+    }
+    gn_string_free(record);
+    atomic_fetch_sub(&producing, 1);
+    return NULL;
+}
+
+static double bench_locked(int threads)
+{
+    pthread_t tid[MAX_THREADS];
+
+    locked_out = output_new(threads);
+    double start = now();
+    for (int i = 0; i < threads; ++i)
+    {
+        pthread_create(&tid[i], NULL, run_locked, (void *)(intptr_t)i);
+    }
+    for (int i = 0; i < threads; ++i)
+    {
+        pthread_join(tid[i], NULL);
+    }
+    double elapsed = now() - start;
+
+    verify(locked_out, threads);
+    gn_string_free(locked_out);
+    return elapsed;
+}
+
+static double bench_shared(int threads)
+{
+    pthread_t tid[MAX_THREADS];
+    gn_string *out = output_new(threads);
+
+    gn_string_mt_init(&shared);
+    atomic_store(&producing, threads);
+    double start = now();
+    for (int i = 0; i < threads; ++i)
+    {
+        pthread_create(&tid[i], NULL, run_shared, (void *)(intptr_t)i);
+    }
+    /* the consumer drains while the producers run, as a log writer would */
+    while (atomic_load(&producing))
+    {
+        if (!gn_string_mt_flush(&shared, out))
+        {
+            sched_yield();
+        }
+    }
+    for (int i = 0; i < threads; ++i)
+    {
+        pthread_join(tid[i], NULL);
+    }
+    gn_string_mt_flush(&shared, out);
+    double elapsed = now() - start;
+
+    verify(out, threads);
+    gn_string_mt_destroy(&shared);
+    gn_string_free(out);
+    return elapsed;
+}
+
+int main(void)
+{
+    gn_string *record = record_new(0);
+    record_length = gn_string_len(record);
+    gn_string_free(record);
+
+    printf("%8s %14s %14s %8s\n", "threads", "mutex(MB/s)", "mt(MB/s)", "speedup");
+    for (int threads = 1; threads <= MAX_THREADS; threads *= 2)
+    {
+        double bytes = (double)threads * RECORDS_PER_THREAD * record_length / (1 << 20);
+        double locked = bench_locked(threads);
+        double lockfree = bench_shared(threads);
+        printf("%8d %14.1f %14.1f %7.2fx\n", threads, bytes / locked, bytes / lockfree, locked / lockfree);
+    }
+
+    return 0;
+}
@@ -13,6 +13,9 @@
 #include <stdarg.h> /* va_list, va_start, va_copy, va_end */
 #include <stdint.h> /* int8_t */
 #include <string.h> /* memcpy, strlen */
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <emmintrin.h> /* _mm_loadu_si128, _mm_cmpeq_epi8, _mm_movemask_epi8 */
+#endif
 
 #define DEFAULT_INCREASE_SIZE   50
 #define MINIMUM_SIZE    1
@@ -37,6 +40,7 @@ typedef struct GNSTRING
 #define LEN_CONSUME(_gn_string) ((_gn_string)->_cons) /* size of _cons */
 #define LEN_DATA(_gn_string) ((_gn_string)->_cons - 1)
 #define IDX_NULL(_gn_string) ((_gn_string)->_cons - 1)
+#define FOLD_LOWER(_c) ((int8_t)(((_c) >= 'A' && (_c) <= 'Z') ? ((_c) | 0x20) : (_c))) /* ASCII-only lowercase */
 
 /**
  * @brief:  assign the blocks to the buffer
@@ -703,6 +707,645 @@ static size_t gn_search_all_c(const char *str, const char *sub, size_t s_length,
     return times;
 }
 
+/*******************************************************************************
+ *              begin case-insensitive substring search functions              *
+ ******************************************************************************/
+
+/**
+ * @brief:  same as _gn_table, but the prefix comparison is done on ASCII-folded bytes
+ */
+static void _gn_table_ci(const int8_t *str, long *next, size_t length)
+{
+    size_t i, j;
+    i = 1, j = 0;
+
+    next[0] = 0;
+
+    int pos_next;
+
+    for (pos_next = 1; i < length; ++pos_next)
+    {
+        if (FOLD_LOWER(str[i]) == FOLD_LOWER(str[j]))
+        {
+            ++i;
+            ++j;
+            next[pos_next] = j;
+        }
+        else if (j)
+        {
+            j = next[j - 1];
+            --pos_next;
+        }
+        else
+        {
+            next[pos_next] = 0;
+            ++i;
+        }
+    }
+}
+
+/**
+ * @brief:  skip to the first position in [tar, end_pos) whose folded byte equals first,
+ *          16 bytes per step when SSE2 is available
+ * @param first:    the folded first byte of the pattern
+ * @return: the position found, or end_pos if there is none
+ */
+static long _gn_skip_ci(const int8_t *str, long tar, long end_pos, int8_t first)
+{
+#if defined(__SSE2__) && defined(__GNUC__)
+    const __m128i lower = _mm_set1_epi8('A' - 1);
+    const __m128i upper = _mm_set1_epi8('Z' + 1);
+    const __m128i bit = _mm_set1_epi8(0x20);
+    const __m128i key = _mm_set1_epi8(first);
+
+    for (; tar + 16 <= end_pos; tar += 16)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i *)&str[tar]);
+        /* bytes >= 0x80 are negative here, so the signed range check leaves them alone */
+        __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(block, lower), _mm_cmplt_epi8(block, upper));
+        block = _mm_or_si128(block, _mm_and_si128(alpha, bit));
+
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, key));
+        if (mask)
+        {
+            return tar + __builtin_ctz(mask);
+        }
+    }
+#endif
+    for (; tar < end_pos; ++tar)
+    {
+        if (FOLD_LOWER(str[tar]) == first)
+        {
+            return tar;
+        }
+    }
+
+    return end_pos;
+}
+
+/**
+ * @brief:  ASCII case-insensitive version of gn_search, the haystack is read in place
+ * @return: the position of the first match in [start_pos, end_pos), or -1
+ */
+static long gn_search_ci(const int8_t *str, long start_pos, long end_pos, const int8_t *sub, long sub_length)
+{
+    long tar, pos;
+    tar = start_pos, pos = 0;
+
+    if (sub_length < 1 || end_pos - start_pos < sub_length)
+    {
+        return -1;
+    }
+
+    long *next = (long *)malloc(sub_length * sizeof(long));
+    if (!next)
+    {
+        FALSE_EXIT();
+    }
+
+    _gn_table_ci(sub, next, sub_length);
+
+    const int8_t first = FOLD_LOWER(sub[0]);
+
+    for (; tar < end_pos;)
+    {
+        if (!pos)
+        {
+            tar = _gn_skip_ci(str, tar, end_pos, first);
+            if (tar == end_pos)
+            {
+                break;
+            }
+        }
+
+        if (FOLD_LOWER(str[tar]) == FOLD_LOWER(sub[pos]))
+        {
+            ++tar;
+            ++pos;
+            if (pos == sub_length)
+            {
+                free(next);
+                return tar - pos;
+            }
+        }
+        else if (pos)
+        {
+            pos = next[pos - 1];
+        }
+        else
+        {
+            ++tar;
+        }
+    }
+
+    free(next);
+    return -1;
+}
+
+/**
+ * @brief:  ASCII case-insensitive version of gn_search_all, overlapping matches are reported
+ * @param stack:    receives the positions of the matches, must hold up to s_length entries
+ * @return: the number of matches
+ */
+static size_t gn_search_all_ci(const int8_t *str, const int8_t *sub, long s_length, long sub_length, long *stack)
+{
+    size_t times = 0;
+
+    long tar, pos;
+    tar = 0, pos = 0;
+
+    if (sub_length < 1 || s_length < sub_length)
+    {
+        return 0;
+    }
+
+    long *next = (long *)malloc(sub_length * sizeof(long));
+    if (!next)
+    {
+        FALSE_EXIT();
+    }
+
+    _gn_table_ci(sub, next, sub_length);
+
+    const int8_t first = FOLD_LOWER(sub[0]);
+
+    for (; tar < s_length;)
+    {
+        if (!pos)
+        {
+            tar = _gn_skip_ci(str, tar, s_length, first);
+            if (tar == s_length)
+            {
+                break;
+            }
+        }
+
+        if (FOLD_LOWER(str[tar]) == FOLD_LOWER(sub[pos]))
+        {
+            ++tar;
+            ++pos;
+        }
+        else if (pos)
+        {
+            pos = next[pos - 1];
+        }
+        else
+        {
+            ++tar;
+        }
+
+        if (pos == sub_length)
+        {
+            stack[times] = tar - pos;
+            ++times;
+            pos = next[pos - 1];
+        }
+    }
+
+    free(next);
+    return times;
+}
+
+static long gn_search_ci_c(const char *str, long start_pos, long end_pos, const char *sub, size_t sub_length)
+{
+    return gn_search_ci((const int8_t *)str, start_pos, end_pos, (const int8_t *)sub, (long)sub_length);
+}
+
+static size_t gn_search_all_ci_c(const char *str, const char *sub, size_t s_length, size_t sub_length, long *stack)
+{
+    return gn_search_all_ci((const int8_t *)str, (const int8_t *)sub, (long)s_length, (long)sub_length, stack);
+}
+
+/*******************************************************************************
+ *                      begin columnar string vector                           *
+ ******************************************************************************/
+
+#define GNSTRING_VEC_MAGIC "GNSV"
+#define GNSTRING_VEC_VERSION 1
+#define GNSTRING_VEC_HEADER 24 /* magic, version, count, arena size */
+
+/**
+ * @struct: _gn_string_vec
+ * @property:  _ptr    pointer to the byte arena holding every element back to back, no NULL bytes
+ * @property:  _alloc  size(in bytes) of the allocated arena
+ * @property:  _cons   size(in bytes) of the arena that is consumed
+ * @property:  _offs   offsets into the arena, element i spans [_offs[i], _offs[i + 1])
+ * @property:  _count  number of elements
+ * @property:  _cap    number of elements _offs has room for
+ */
+typedef struct GNSTRING_VEC
+{
+    int8_t *_ptr;
+    size_t _alloc;
+    size_t _cons;
+    size_t *_offs;
+    size_t _count;
+    size_t _cap;
+} gn_string_vec;
+
+#define VEC_COUNT(_vec) ((_vec)->_count)
+#define VEC_AT(_vec, _i) (&(_vec)->_ptr[(_vec)->_offs[_i]])
+#define VEC_LEN(_vec, _i) ((_vec)->_offs[(_i) + 1] - (_vec)->_offs[_i])
+
+/**
+ * @brief:  a borrowed element, valid until the next push into its vector,
+ *          gn_string_vec_push itself accepts one of its own views as src
+ */
+typedef struct GNSTRING_VIEW
+{
+    const int8_t *_ptr;
+    size_t _len;
+} gn_string_view;
+
+static void _gn_vec_reserve_offs(gn_string_vec *vec, size_t count)
+{
+    if (count <= vec->_cap)
+    {
+        return;
+    }
+
+    size_t cap = MAX(count, vec->_cap * 2);
+    size_t *offs = (size_t *)realloc(vec->_offs, (cap + 1) * sizeof(size_t));
+    if (!offs)
+    {
+        FALSE_EXIT();
+    }
+    vec->_offs = offs;
+    vec->_cap = cap;
+}
+
+static void _gn_vec_reserve_bytes(gn_string_vec *vec, size_t bytes)
+{
+    if (bytes <= vec->_alloc)
+    {
+        return;
+    }
+
+    size_t alloc = MAX(bytes, vec->_alloc * 2);
+    BLOCK_REALLOC(vec->_ptr, alloc);
+    vec->_alloc = alloc;
+}
+
+/**
+ * @brief:  initialize the vector with room for count elements of bytes in total
+ */
+static void gn_string_vec_init_n(gn_string_vec *vec, size_t count, size_t bytes)
+{
+    bytes = MAX(bytes, MINIMUM_SIZE);
+
+    BLOCK_ALLOC(vec->_ptr, bytes);
+    vec->_alloc = bytes;
+    vec->_cons = 0;
+    vec->_offs = (size_t *)malloc((count + 1) * sizeof(size_t));
+    if (!vec->_offs)
+    {
+        FALSE_EXIT();
+    }
+    vec->_offs[0] = 0;
+    vec->_count = 0;
+    vec->_cap = count;
+}
+
+static void gn_string_vec_free(gn_string_vec *vec)
+{
+    BLOCK_FREE(vec->_ptr);
+    free(vec->_offs);
+    vec->_offs = NULL;
+    vec->_alloc = vec->_cons = 0;
+    vec->_count = vec->_cap = 0;
+}
+
+/**
+ * @brief:  shadow clear, the buffers are kept for reuse
+ */
+static void gn_string_vec_clear(gn_string_vec *vec)
+{
+    vec->_cons = 0;
+    vec->_count = 0;
+}
+
+/**
+ * @brief:  append length bytes from src as a new element, src may point into the arena itself
+ */
+static void gn_string_vec_push(gn_string_vec *vec, const void *src, size_t length)
+{
+    uintptr_t from = (uintptr_t)src;
+    uintptr_t base = (uintptr_t)vec->_ptr;
+    int inside = from >= base && from < base + vec->_cons;
+
+    _gn_vec_reserve_offs(vec, vec->_count + 1);
+    _gn_vec_reserve_bytes(vec, vec->_cons + length);
+
+    /* the arena may have moved, so find src again by its offset */
+    if (inside)
+    {
+        src = &vec->_ptr[from - base];
+    }
+
+    BLOCK_COPY(&vec->_ptr[vec->_cons], src, length);
+    vec->_cons += length;
+    vec->_offs[++vec->_count] = vec->_cons;
+}
+
+static gn_string_view gn_string_vec_get(const gn_string_vec *vec, size_t idx)
+{
+    gn_string_view view;
+    view._ptr = VEC_AT(vec, idx);
+    view._len = VEC_LEN(vec, idx);
+    return view;
+}
+
+/**
+ * @brief:  run one KMP pass over the whole arena, the state is reset at every element boundary
+ *          and the first byte of the pattern is located with memchr, or _gn_skip_ci when folding
+ * @param idx:  receives the indexes of the elements containing sub, in ascending order
+ */
+static size_t _gn_vec_scan(const gn_string_vec *vec, const int8_t *sub, long sub_length, size_t *idx, int fold)
+{
+    size_t times = 0;
+
+    if (sub_length < 1 || !vec->_count)
+    {
+        return 0;
+    }
+
+    long *next = (long *)malloc(sub_length * sizeof(long));
+    if (!next)
+    {
+        FALSE_EXIT();
+    }
+
+    if (fold)
+    {
+        _gn_table_ci(sub, next, sub_length);
+    }
+    else
+    {
+        _gn_table(sub, next, sub_length);
+    }
+
+    const int8_t *str = vec->_ptr;
+    const long end_pos = (long)vec->_cons;
+    const int8_t first = fold ? FOLD_LOWER(sub[0]) : sub[0];
+
+    size_t cur = 0;
+    long tar, pos;
+    tar = 0, pos = 0;
+
+    for (; tar < end_pos;)
+    {
+        if (!pos)
+        {
+            if (fold)
+            {
+                tar = _gn_skip_ci(str, tar, end_pos, first);
+            }
+            else
+            {
+                const int8_t *hit = (const int8_t *)memchr(&str[tar], (uint8_t)first, end_pos - tar);
+                tar = hit ? hit - str : end_pos;
+            }
+            if (tar == end_pos)
+            {
+                break;
+            }
+            while ((long)vec->_offs[cur + 1] <= tar)
+            {
+                ++cur;
+            }
+        }
+
+        int8_t a = fold ? FOLD_LOWER(str[tar]) : str[tar];
+        int8_t b = fold ? FOLD_LOWER(sub[pos]) : sub[pos];
+
+        if (a == b)
+        {
+            ++tar;
+            ++pos;
+            if (pos == sub_length)
+            {
+                idx[times] = cur;
+                ++times;
+                tar = vec->_offs[cur + 1];
+                pos = 0;
+            }
+            else if (tar == (long)vec->_offs[cur + 1])
+            {
+                /* a match may not run into the next element */
+                pos = 0;
+            }
+        }
+        else if (pos)
+        {
+            pos = next[pos - 1];
+        }
+        else
+        {
+            ++tar;
+        }
+    }
+
+    free(next);
+    return times;
+}
+
+/**
+ * @brief:  find every element containing sub
+ * @param idx:  receives the element indexes, must hold up to VEC_COUNT(vec) entries
+ * @return: the number of elements found
+ */
+static size_t gn_string_vec_search_all(const gn_string_vec *vec, const int8_t *sub, long sub_length, size_t *idx)
+{
+    return _gn_vec_scan(vec, sub, sub_length, idx, 0);
+}
+
+/**
+ * @brief:  ASCII case-insensitive version of gn_string_vec_search_all
+ */
+static size_t gn_string_vec_search_all_ci(const gn_string_vec *vec, const int8_t *sub, long sub_length, size_t *idx)
+{
+    return _gn_vec_scan(vec, sub, sub_length, idx, 1);
+}
+
+typedef struct GNSTRING_VEC_KEY
+{
+    const int8_t *_ptr;
+    size_t _len;
+    size_t _idx;
+} _gn_vec_key;
+
+static int _gn_vec_key_cmp(const void *lhs, const void *rhs)
+{
+    const _gn_vec_key *a = (const _gn_vec_key *)lhs;
+    const _gn_vec_key *b = (const _gn_vec_key *)rhs;
+
+    int cmp = memcmp(a->_ptr, b->_ptr, MIN(a->_len, b->_len));
+    if (cmp)
+    {
+        return cmp;
+    }
+    if (a->_len != b->_len)
+    {
+        return a->_len < b->_len ? -1 : 1;
+    }
+    /* keep the sort stable, qsort is not */
+    return a->_idx < b->_idx ? -1 : (a->_idx > b->_idx);
+}
+
+/**
+ * @brief:  sort the elements bytewise without moving them
+ * @param perm: receives VEC_COUNT(vec) indexes, perm[k] is the element that sorts k-th
+ */
+static void gn_string_vec_sort(const gn_string_vec *vec, size_t *perm)
+{
+    size_t i;
+
+    if (!vec->_count)
+    {
+        return;
+    }
+
+    _gn_vec_key *keys = (_gn_vec_key *)malloc(vec->_count * sizeof(_gn_vec_key));
+    if (!keys)
+    {
+        FALSE_EXIT();
+    }
+
+    for (i = 0; i < vec->_count; ++i)
+    {
+        keys[i]._ptr = VEC_AT(vec, i);
+        keys[i]._len = VEC_LEN(vec, i);
+        keys[i]._idx = i;
+    }
+
+    qsort(keys, vec->_count, sizeof(_gn_vec_key), _gn_vec_key_cmp);
+
+    for (i = 0; i < vec->_count; ++i)
+    {
+        perm[i] = keys[i]._idx;
+    }
+
+    free(keys);
+}
+
+/**
+ * @brief:  append the elements src[perm[0]], src[perm[1]], ... to dest, e.g. to materialize a sort
+ *          dest may be src, the elements are then appended after the existing ones
+ */
+static void gn_string_vec_gather(gn_string_vec *dest, const gn_string_vec *src, const size_t *perm, size_t count)
+{
+    size_t i, bytes = 0;
+
+    for (i = 0; i < count; ++i)
+    {
+        bytes += VEC_LEN(src, perm[i]);
+    }
+
+    /* grow first: when dest is src, every read below goes through the new buffers */
+    _gn_vec_reserve_offs(dest, dest->_count + count);
+    _gn_vec_reserve_bytes(dest, dest->_cons + bytes);
+
+    for (i = 0; i < count; ++i)
+    {
+        size_t length = VEC_LEN(src, perm[i]);
+        BLOCK_COPY(&dest->_ptr[dest->_cons], VEC_AT(src, perm[i]), length);
+        dest->_cons += length;
+        dest->_offs[++dest->_count] = dest->_cons;
+    }
+}
+
+/**
+ * @brief:  append the vector to out in the flat binary format, native byte order:
+ *          "GNSV" | u32 version | u64 count | u64 arena size | u64 offsets[count + 1] | arena
+ */
+static void gn_string_vec_serialize(const gn_string_vec *vec, gn_string *out)
+{
+    size_t i;
+    size_t total = GNSTRING_VEC_HEADER + (vec->_count + 1) * sizeof(uint64_t) + vec->_cons;
+    uint32_t version = GNSTRING_VEC_VERSION;
+    uint64_t count = vec->_count;
+    uint64_t bytes = vec->_cons;
+
+    if (LEN_ALLOC(out) - LEN_CONSUME(out) < total)
+    {
+        GNSTRING_REALLOC_N(out, LEN_CONSUME(out) + total);
+    }
+
+    int8_t *dst = &out->_ptr[IDX_NULL(out)];
+    BLOCK_COPY(dst, GNSTRING_VEC_MAGIC, 4);
+    BLOCK_COPY(dst + 4, &version, sizeof(version));
+    BLOCK_COPY(dst + 8, &count, sizeof(count));
+    BLOCK_COPY(dst + 16, &bytes, sizeof(bytes));
+    dst += GNSTRING_VEC_HEADER;
+
+    for (i = 0; i <= vec->_count; ++i)
+    {
+        uint64_t off = vec->_offs[i];
+        BLOCK_COPY(dst, &off, sizeof(off));
+        dst += sizeof(off);
+    }
+    BLOCK_COPY(dst, vec->_ptr, vec->_cons);
+
+    LEN_CONSUME(out) += total;
+    out->_ptr[IDX_NULL(out)] = 0;
+}
+
+/**
+ * @brief:  load a vector written by gn_string_vec_serialize, vec must be initialized and is overwritten
+ * @return: the number of bytes read from buf, or 0 if buf does not hold a valid vector, vec is then left empty
+ */
+static size_t gn_string_vec_deserialize(gn_string_vec *vec, const int8_t *buf, size_t length)
+{
+    size_t i;
+    uint32_t version;
+    uint64_t count, bytes, off, prev = 0;
+
+    gn_string_vec_clear(vec);
+
+    if (length < GNSTRING_VEC_HEADER || memcmp(buf, GNSTRING_VEC_MAGIC, 4))
+    {
+        return 0;
+    }
+    memcpy(&version, buf + 4, sizeof(version));
+    memcpy(&count, buf + 8, sizeof(count));
+    memcpy(&bytes, buf + 16, sizeof(bytes));
+
+    if (version != GNSTRING_VEC_VERSION || count >= (length - GNSTRING_VEC_HEADER) / sizeof(uint64_t))
+    {
+        return 0;
+    }
+
+    size_t head = GNSTRING_VEC_HEADER + (count + 1) * sizeof(uint64_t);
+    if (bytes > length - head)
+    {
+        return 0;
+    }
+
+    _gn_vec_reserve_offs(vec, count);
+    _gn_vec_reserve_bytes(vec, bytes);
+
+    for (i = 0; i <= count; ++i)
+    {
+        memcpy(&off, buf + GNSTRING_VEC_HEADER + i * sizeof(uint64_t), sizeof(off));
+        if (off < prev || off > bytes || (!i && off))
+        {
+            return 0;
+        }
+        vec->_offs[i] = off;
+        prev = off;
+    }
+    if (prev != bytes)
+    {
+        return 0;
+    }
+
+    BLOCK_COPY(vec->_ptr, buf + head, bytes);
+    vec->_cons = bytes;
+    vec->_count = count;
+
+    return head + bytes;
+}
+
 #define gn_string_to_str(_gn_string) ((char *)((_gn_string)->_ptr)) /* return the data in type of pointer to char */
 #define gn_string_len(_gn_string) LEN_DATA(_gn_string) /* return the length of gn_string */
 #define gn_string_new(_gn_string) GNSTRING_ALLOC(_gn_string)
@@ -718,5 +1361,8 @@ static size_t gn_search_all_c(const char *str, const char *sub, size_t s_length,
 #define gn_string_copy(_cpy,_src) GNSTRING_COPY(_cpy, _src)
 #define gn_string_deepcopy(_cpy, _src) GNSTRING_DEEPCOPY(_cpy, _src) 
 #define gn_string_slice(_sub,_copy,_spos,_epos) GNSTRING_SLICE(_sub,_copy,_spos,_epos)
+#define gn_string_vec_init(_vec) gn_string_vec_init_n(_vec, DEFAULT_INCREASE_SIZE, DEFAULT_INCREASE_SIZE)
+#define gn_string_vec_size(_vec) VEC_COUNT(_vec) /* return the number of elements */
+#define gn_string_vec_push_str(_vec,_src) gn_string_vec_push(_vec, (_src)->_ptr, LEN_DATA(_src))
 
 #endif
\ No newline at end of file
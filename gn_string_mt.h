@@ -0,0 +1,435 @@
+/**
+ * @brief: Multi-producer append buffer built on top of gn_string, requires C11 atomics.
+ *         Producers reserve space with an atomic fetch-add and copy in parallel,
+ *         a single consumer drains the committed bytes into a gn_string.
+ */
+
+#ifndef GNSTRING_MT_H
+#define GNSTRING_MT_H
+
+#include <stdatomic.h> /* atomic_fetch_add, atomic_compare_exchange_strong */
+#include <stdint.h>    /* SIZE_MAX, uint64_t */
+#include <stdlib.h>    /* aligned_alloc */
+
+#include "gn_string.h"
+
+#define DEFAULT_SEGMENT_SIZE 65536
+#define CACHE_LINE_SIZE 64
+#define SEGMENT_OPEN SIZE_MAX
+#define SEGMENT_PIN ((uint64_t)1 << 40)                        /* one producer holding the segment, kept above the byte count */
+#define SEGMENT_BYTES(_commit) ((_commit) & (SEGMENT_PIN - 1)) /* committed bytes without the pins */
+#define SEGMENT_PHASE (~(SIZE_MAX >> 1))                       /* top bit of _cons, flipped by the consumer */
+#define SEGMENT_OFFSET(_cons) ((_cons) & ~SEGMENT_PHASE)      /* reserved bytes without the phase */
+
+/**
+ * @struct: _gn_string_seg
+ * @property:  _ptr     pointer to allocated buffer, never moved once producers can see it
+ * @property:  _alloc   size(in bytes) of the allocated buffer
+ * @property:  _cons    size(in bytes) reserved by producers, may run past _alloc, plus the phase bit
+ * @property:  _commit  size(in bytes) whose copy has finished, per phase,
+ *                      _commit[0] also counts SEGMENT_PIN per producer holding the segment
+ * @property:  _end     size(in bytes) of the data once the segment is sealed, SEGMENT_OPEN before
+ * @property:  _next    the segment that takes over once this one is full
+ * @property:  _link    next entry in the retired list, the pool or the spare list
+ *
+ * A reservation commits into the counter of the phase it got from _cons. The
+ * consumer flips the phase to cut the segment: every reservation below the cut
+ * has the old phase, so once that counter reaches what the consumer expects,
+ * the bytes up to the cut are complete even while later copies are in flight.
+ *
+ * _cons and _commit are hit by every append, so each gets a cache line of its
+ * own, away from the fields that only change when the segment rolls over.
+ *
+ * A segment struct is never freed before gn_string_mt_destroy, only its buffer is:
+ * drained segments go back to the pool, so a producer still holding a stale
+ * pointer can always pin it and find out from _tail that it is no longer current.
+ *
+ * Rollover never waits on another thread: the consumer keeps a segment linked
+ * behind the tail ahead of time, and a producer that finds none links its own.
+ */
+typedef struct GNSTRING_SEG
+{
+    int8_t *_ptr;
+    size_t _alloc;
+    atomic_size_t _end;
+    struct GNSTRING_SEG *_Atomic _next;
+    struct GNSTRING_SEG *_link;
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t _cons;
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint64_t _commit[2];
+} gn_string_seg;
+
+/**
+ * @struct: _gn_string_mt
+ * @property:  _tail     the segment producers are reserving in
+ * @property:  _seg_size minimum size(in bytes) of a new segment
+ * @property:  _spare    segments producers allocated but lost the race to link, handed to the consumer
+ * @property:  _head     the oldest segment not yet drained, owned by the consumer
+ * @property:  _flushed  size(in bytes) of _head already handed to the consumer
+ * @property:  _cut      size(in bytes) of _head below the last phase flip
+ * @property:  _want     bytes each _commit counter of _head must reach for the data below _cut
+ * @property:  _phase    the phase _head hands out to new reservations
+ * @property:  _retired  drained segments some producer still pins, owned by the consumer
+ * @property:  _pool     recycled segments without a buffer, owned by the consumer
+ *
+ * The fields producers read on every append, the spare list and the consumer's own
+ * state sit on separate cache lines, so a flush does not steal the producers' line.
+ */
+typedef struct GNSTRING_MT
+{
+    _Alignas(CACHE_LINE_SIZE) gn_string_seg *_Atomic _tail;
+    size_t _seg_size;
+    _Alignas(CACHE_LINE_SIZE) gn_string_seg *_Atomic _spare;
+    _Alignas(CACHE_LINE_SIZE) gn_string_seg *_head;
+    size_t _flushed;
+    size_t _cut;
+    size_t _want[2];
+    int _phase;
+    gn_string_seg *_retired;
+    gn_string_seg *_pool;
+} gn_string_mt;
+
+static void _gn_seg_free_list(gn_string_seg *seg, int linked)
+{
+    while (seg)
+    {
+        gn_string_seg *next = linked ? seg->_link : atomic_load(&seg->_next);
+        free(seg->_ptr);
+        free(seg);
+        seg = next;
+    }
+}
+
+static gn_string_seg *_gn_seg_new(size_t amount)
+{
+    gn_string_seg *seg = (gn_string_seg *)aligned_alloc(CACHE_LINE_SIZE, sizeof(gn_string_seg));
+    if (!seg)
+    {
+        FALSE_EXIT();
+    }
+
+    BLOCK_ALLOC(seg->_ptr, amount);
+    seg->_alloc = amount;
+    atomic_init(&seg->_end, SEGMENT_OPEN);
+    atomic_init(&seg->_next, NULL);
+    seg->_link = NULL;
+    atomic_init(&seg->_cons, 0);
+    atomic_init(&seg->_commit[0], 0);
+    atomic_init(&seg->_commit[1], 0);
+
+    return seg;
+}
+
+/**
+ * @brief:  take a segment from the pool or allocate one, consumer only
+ */
+static gn_string_seg *_gn_seg_take(gn_string_mt *mt)
+{
+    gn_string_seg *seg = mt->_pool;
+
+    if (!seg)
+    {
+        return _gn_seg_new(mt->_seg_size);
+    }
+
+    mt->_pool = seg->_link;
+    BLOCK_ALLOC(seg->_ptr, mt->_seg_size);
+    seg->_alloc = mt->_seg_size;
+    seg->_link = NULL;
+
+    return seg;
+}
+
+/**
+ * @brief:  reset a segment that nobody pins and keep it in the pool, consumer only
+ */
+static void _gn_seg_put(gn_string_mt *mt, gn_string_seg *seg)
+{
+    BLOCK_FREE(seg->_ptr);
+    seg->_alloc = 0;
+    atomic_store(&seg->_cons, 0);
+    /* a stale producer may pin it at any moment, so only take the bytes away */
+    atomic_fetch_sub(&seg->_commit[0], SEGMENT_BYTES(atomic_load(&seg->_commit[0])));
+    atomic_store(&seg->_commit[1], 0);
+    atomic_store(&seg->_end, SEGMENT_OPEN);
+    atomic_store(&seg->_next, NULL);
+
+    seg->_link = mt->_pool;
+    mt->_pool = seg;
+}
+
+/**
+ * @brief:  return the segment after seg, linking a new one if there is none yet
+ *          a producer that loses the race hands its segment to the consumer instead of freeing it
+ */
+static gn_string_seg *_gn_seg_link(gn_string_mt *mt, gn_string_seg *seg, size_t length)
+{
+    gn_string_seg *next = atomic_load(&seg->_next);
+
+    if (next)
+    {
+        return next;
+    }
+
+    gn_string_seg *fresh = _gn_seg_new(MAX(mt->_seg_size, length));
+    if (atomic_compare_exchange_strong(&seg->_next, &next, fresh))
+    {
+        return fresh;
+    }
+
+    fresh->_link = atomic_load(&mt->_spare);
+    while (!atomic_compare_exchange_weak(&mt->_spare, &fresh->_link, fresh))
+    {
+    }
+
+    return next;
+}
+
+/**
+ * @brief:  initialize the buffer, every segment holds at least seg_size bytes
+ */
+static void gn_string_mt_init_n(gn_string_mt *mt, size_t seg_size)
+{
+    seg_size = MAX(seg_size, MINIMUM_SIZE);
+
+    atomic_init(&mt->_spare, NULL);
+    mt->_seg_size = seg_size;
+    mt->_head = _gn_seg_new(seg_size);
+    mt->_flushed = 0;
+    mt->_cut = 0;
+    mt->_want[0] = mt->_want[1] = 0;
+    mt->_phase = 0;
+    mt->_retired = NULL;
+    mt->_pool = NULL;
+    atomic_init(&mt->_tail, mt->_head);
+}
+
+/**
+ * @brief:  release every segment, no producer may be running
+ */
+static void gn_string_mt_destroy(gn_string_mt *mt)
+{
+    _gn_seg_free_list(mt->_retired, 1);
+    _gn_seg_free_list(mt->_head, 0);
+    _gn_seg_free_list(mt->_pool, 1);
+    _gn_seg_free_list(atomic_load(&mt->_spare), 1);
+    mt->_head = NULL;
+    mt->_retired = NULL;
+    mt->_pool = NULL;
+    atomic_store(&mt->_spare, NULL);
+    atomic_store(&mt->_tail, NULL);
+}
+
+/**
+ * @brief:  append length bytes, safe to call from any number of threads at once
+ *
+ * The tail segment is pinned before use and checked to still be the tail.
+ * A reservation that runs past its end is thrown away. The unique reservation
+ * straddling the end seals the segment; every producer that overflowed makes
+ * sure a next segment is linked, moves the tail forward and retries.
+ */
+static void gn_string_mt_append(gn_string_mt *mt, const void *src, size_t length)
+{
+    if (!length)
+    {
+        return;
+    }
+
+    for (;;)
+    {
+        gn_string_seg *seg = atomic_load(&mt->_tail);
+
+        atomic_fetch_add(&seg->_commit[0], SEGMENT_PIN);
+        if (atomic_load(&mt->_tail) != seg)
+        {
+            atomic_fetch_sub(&seg->_commit[0], SEGMENT_PIN);
+            continue;
+        }
+
+        size_t cons = atomic_fetch_add(&seg->_cons, length);
+        size_t off = SEGMENT_OFFSET(cons);
+
+        if (off + length <= seg->_alloc)
+        {
+            memcpy(&seg->_ptr[off], src, length);
+            if (cons & SEGMENT_PHASE)
+            {
+                atomic_fetch_add(&seg->_commit[1], length);
+                atomic_fetch_sub(&seg->_commit[0], SEGMENT_PIN);
+            }
+            else
+            {
+                /* commit the bytes and drop the pin in one step */
+                atomic_fetch_add(&seg->_commit[0], (uint64_t)length - SEGMENT_PIN);
+            }
+            return;
+        }
+
+        if (off <= seg->_alloc)
+        {
+            atomic_store(&seg->_end, off);
+        }
+
+        gn_string_seg *next = _gn_seg_link(mt, seg, length);
+        gn_string_seg *expected = seg;
+        atomic_compare_exchange_strong(&mt->_tail, &expected, next);
+        atomic_fetch_sub(&seg->_commit[0], SEGMENT_PIN);
+    }
+}
+
+/**
+ * @brief:  append the data of a gn_string, see gn_string_mt_append
+ */
+#define gn_string_mt_concat(_mt, _src)                              \
+    do                                                              \
+    {                                                               \
+        if (_src)                                                   \
+        {                                                           \
+            gn_string_mt_append(_mt, (_src)->_ptr, LEN_DATA(_src)); \
+        }                                                           \
+    } while (0)
+
+/**
+ * @brief:  flip the phase of _head, so the reservations below the returned offset can be waited for
+ */
+static void _gn_seg_cut(gn_string_mt *mt, gn_string_seg *seg)
+{
+    size_t cons = SEGMENT_OFFSET(atomic_load(&seg->_cons));
+    if (cons == mt->_cut || cons > seg->_alloc)
+    {
+        return;
+    }
+
+    cons = SEGMENT_OFFSET(atomic_fetch_xor(&seg->_cons, SEGMENT_PHASE));
+    if (cons > seg->_alloc)
+    {
+        /* the segment filled up meanwhile, everything past the flip overflowed and never commits */
+        atomic_fetch_xor(&seg->_cons, SEGMENT_PHASE);
+        return;
+    }
+
+    mt->_want[mt->_phase] += cons - mt->_cut;
+    mt->_cut = cons;
+    mt->_phase ^= 1;
+}
+
+/**
+ * @brief:  move every committed, contiguous byte into dest, only one consumer may call it
+ *          a copy still in flight holds back only the bytes after the cut it falls behind
+ * @return: the number of bytes moved
+ */
+static size_t gn_string_mt_flush(gn_string_mt *mt, gn_string *dest)
+{
+    size_t moved = 0;
+
+    for (;;)
+    {
+        gn_string_seg *seg = mt->_head;
+        size_t end = atomic_load(&seg->_end);
+        size_t ready = mt->_flushed;
+
+        if (mt->_flushed == mt->_cut && end == SEGMENT_OPEN)
+        {
+            _gn_seg_cut(mt, seg);
+        }
+
+        if (mt->_flushed < mt->_cut)
+        {
+            /* the window below the cut committed into the phase before the current one */
+            int phase = !mt->_phase;
+            if (SEGMENT_BYTES(atomic_load(&seg->_commit[phase])) == mt->_want[phase])
+            {
+                ready = mt->_cut;
+            }
+        }
+        else if (end != SEGMENT_OPEN)
+        {
+            /* sealed: the last window runs up to _end, nothing more can arrive */
+            int phase = mt->_phase;
+            if (SEGMENT_BYTES(atomic_load(&seg->_commit[phase])) == mt->_want[phase] + (end - mt->_cut))
+            {
+                ready = end;
+            }
+        }
+
+        if (ready > mt->_flushed)
+        {
+            size_t length = ready - mt->_flushed;
+            if (LEN_ALLOC(dest) - LEN_CONSUME(dest) < length)
+            {
+                GNSTRING_REALLOC_N(dest, LEN_ALLOC(dest) + MAX(length, LEN_ALLOC(dest)));
+            }
+            memcpy(&dest->_ptr[IDX_NULL(dest)], &seg->_ptr[mt->_flushed], length);
+            LEN_CONSUME(dest) += length;
+            dest->_ptr[IDX_NULL(dest)] = 0;
+
+            mt->_flushed = ready;
+            moved += length;
+
+            /* a sealed segment may still have its last window to hand over */
+            if (end != SEGMENT_OPEN && ready != end)
+            {
+                continue;
+            }
+        }
+
+        gn_string_seg *next = atomic_load(&seg->_next);
+        if (end == SEGMENT_OPEN || mt->_flushed != end || !next || atomic_load(&mt->_tail) == seg)
+        {
+            break;
+        }
+
+        /* _tail has moved on, so from here on a new pin can only fail its check and go away */
+        mt->_head = next;
+        mt->_flushed = 0;
+        mt->_cut = 0;
+        mt->_want[0] = mt->_want[1] = 0;
+        mt->_phase = 0;
+        seg->_link = mt->_retired;
+        mt->_retired = seg;
+    }
+
+    /* recycle every retired segment whose pins are gone, the rest are tried again next time */
+    gn_string_seg **link = &mt->_retired;
+    while (*link)
+    {
+        gn_string_seg *seg = *link;
+
+        /* every byte was flushed, so anything left above the byte count is a pin */
+        if (atomic_load(&seg->_commit[0]) < SEGMENT_PIN)
+        {
+            *link = seg->_link;
+            _gn_seg_put(mt, seg);
+        }
+        else
+        {
+            link = &seg->_link;
+        }
+    }
+
+    /* segments producers allocated but could not link go to the pool */
+    gn_string_seg *spare = atomic_exchange(&mt->_spare, NULL);
+    while (spare)
+    {
+        gn_string_seg *seg = spare;
+        spare = seg->_link;
+        _gn_seg_put(mt, seg);
+    }
+
+    /* keep a segment linked behind the tail, so rollover rarely has to allocate */
+    gn_string_seg *tail = atomic_load(&mt->_tail);
+    if (!atomic_load(&tail->_next))
+    {
+        gn_string_seg *next = _gn_seg_take(mt);
+        gn_string_seg *expected = NULL;
+        if (!atomic_compare_exchange_strong(&tail->_next, &expected, next))
+        {
+            _gn_seg_put(mt, next);
+        }
+    }
+
+    return moved;
+}
+
+#define gn_string_mt_init(_mt) gn_string_mt_init_n(_mt, DEFAULT_SEGMENT_SIZE)
+
+#endif
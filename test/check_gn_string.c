@@ -0,0 +1,347 @@
+/**
+ * @brief: checks for gn_string.h, compared against naive reference implementations
+ *         build: cc -std=c99 -O2 -I.. check_gn_string.c -o check_gn_string
+ */
+
+#include "gn_string.h"
+
+#define CHECK(_cond)                                                                  \
+    do                                                                                \
+    {                                                                                 \
+        if (!(_cond))                                                                 \
+        {                                                                             \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #_cond); \
+            exit(1);                                                                  \
+        }                                                                             \
+    } while (0)
+
+#define ROUNDS 20000
+#define MAX_HAYSTACK 80 /* several SSE2 blocks plus a scalar tail */
+#define MAX_PATTERN 5
+#define MAX_ELEMENTS 40
+#define MAX_ELEMENT 20
+
+/* letters on both sides of the case bit, their neighbours outside A-Z/a-z, and bytes >= 0x80 */
+static const char alphabet[] = "aAzZ@[`{\xc1\xe1";
+
+static int fold_eq(int8_t a, int8_t b)
+{
+    unsigned char x = (unsigned char)a, y = (unsigned char)b;
+    if (x >= 'A' && x <= 'Z')
+    {
+        x |= 0x20;
+    }
+    if (y >= 'A' && y <= 'Z')
+    {
+        y |= 0x20;
+    }
+    return x == y;
+}
+
+static size_t naive_all_ci(const int8_t *str, long s_length, const int8_t *sub, long sub_length, long *stack)
+{
+    size_t times = 0;
+    for (long i = 0; i + sub_length <= s_length; ++i)
+    {
+        long j = 0;
+        while (j < sub_length && fold_eq(str[i + j], sub[j]))
+        {
+            ++j;
+        }
+        if (j == sub_length)
+        {
+            stack[times++] = i;
+        }
+    }
+    return times;
+}
+
+static void fill(int8_t *buf, long length)
+{
+    for (long i = 0; i < length; ++i)
+    {
+        buf[i] = alphabet[rand() % (sizeof(alphabet) - 1)];
+    }
+}
+
+static void check_search_ci_random(void)
+{
+    int8_t str[MAX_HAYSTACK], sub[MAX_PATTERN];
+    long expect[MAX_HAYSTACK], found[MAX_HAYSTACK];
+
+    for (int round = 0; round < ROUNDS; ++round)
+    {
+        long s_length = rand() % (MAX_HAYSTACK + 1);
+        long sub_length = 1 + rand() % MAX_PATTERN;
+        fill(str, s_length);
+        fill(sub, sub_length);
+
+        size_t times = naive_all_ci(str, s_length, sub, sub_length, expect);
+        CHECK(gn_search_all_ci(str, sub, s_length, sub_length, found) == times);
+        CHECK(!memcmp(found, expect, times * sizeof(long)));
+
+        /* the first match at or after start_pos must end before end_pos */
+        long start_pos = s_length ? rand() % s_length : 0;
+        long end_pos = start_pos + rand() % (s_length - start_pos + 1);
+        long first = -1;
+        for (size_t i = 0; i < times; ++i)
+        {
+            if (expect[i] >= start_pos && expect[i] + sub_length <= end_pos)
+            {
+                first = expect[i];
+                break;
+            }
+        }
+        CHECK(gn_search_ci(str, start_pos, end_pos, sub, sub_length) == first);
+    }
+}
+
+static void check_search_ci_boundaries(void)
+{
+    char str[48];
+    long stack[48];
+
+    /* a match starting on every position of a 48-byte haystack, across the 16-byte blocks */
+    for (long at = 0; at + 3 <= 48; ++at)
+    {
+        memset(str, '-', sizeof(str));
+        memcpy(&str[at], "KeY", 3);
+        CHECK(gn_search_ci_c(str, 0, 48, "kEy", 3) == at);
+        CHECK(gn_search_all_ci_c(str, "KEY", 48, 3, stack) == 1 && stack[0] == at);
+    }
+
+    /* '@' '[' '`' '{' sit next to the letters and must not fold */
+    CHECK(gn_search_ci_c("@@@@@@@@@@@@@@@@@@@@", 0, 20, "`", 1) == -1);
+    CHECK(gn_search_ci_c("[[[[[[[[[[[[[[[[[[[[", 0, 20, "{", 1) == -1);
+    CHECK(gn_search_ci_c("\xc1\xc1\xc1\xc1\xc1\xc1\xc1\xc1\xc1\xc1\xc1\xc1\xc1\xc1\xc1\xc1\xc1", 0, 17, "\xe1", 1) == -1);
+
+    /* overlapping matches are all reported */
+    CHECK(gn_search_all_ci_c("AaAaA", "aa", 5, 2, stack) == 4);
+
+    CHECK(gn_search_ci_c("abc", 0, 3, "", 0) == -1);
+    CHECK(gn_search_ci_c("abc", 0, 3, "abcd", 4) == -1);
+    CHECK(gn_search_all_ci_c("abc", "abcd", 3, 4, stack) == 0);
+}
+
+static int naive_has(const int8_t *str, long s_length, const int8_t *sub, long sub_length, int fold)
+{
+    for (long i = 0; i + sub_length <= s_length; ++i)
+    {
+        long j = 0;
+        while (j < sub_length && (fold ? fold_eq(str[i + j], sub[j]) : str[i + j] == sub[j]))
+        {
+            ++j;
+        }
+        if (j == sub_length)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void check_vec_search_random(void)
+{
+    int8_t elements[MAX_ELEMENTS][MAX_ELEMENT], sub[MAX_PATTERN];
+    long lengths[MAX_ELEMENTS];
+    size_t found[MAX_ELEMENTS];
+    gn_string_vec vec;
+
+    gn_string_vec_init(&vec);
+    for (int round = 0; round < ROUNDS / 10; ++round)
+    {
+        /* short elements, many of them empty, so patterns often straddle a boundary */
+        long count = rand() % (MAX_ELEMENTS + 1);
+        gn_string_vec_clear(&vec);
+        for (long i = 0; i < count; ++i)
+        {
+            lengths[i] = rand() % 3 ? rand() % MAX_ELEMENT : 0;
+            fill(elements[i], lengths[i]);
+            gn_string_vec_push(&vec, elements[i], lengths[i]);
+        }
+        CHECK(gn_string_vec_size(&vec) == (size_t)count);
+
+        long sub_length = 1 + rand() % MAX_PATTERN;
+        fill(sub, sub_length);
+
+        for (int fold = 0; fold < 2; ++fold)
+        {
+            size_t times = fold ? gn_string_vec_search_all_ci(&vec, sub, sub_length, found)
+                                : gn_string_vec_search_all(&vec, sub, sub_length, found);
+            size_t expect = 0;
+            for (long i = 0; i < count; ++i)
+            {
+                if (naive_has(elements[i], lengths[i], sub, sub_length, fold))
+                {
+                    CHECK(expect < times && found[expect] == (size_t)i);
+                    ++expect;
+                }
+            }
+            CHECK(times == expect);
+        }
+    }
+    gn_string_vec_free(&vec);
+}
+
+static void check_vec_boundaries(void)
+{
+    size_t found[8];
+    gn_string_vec vec;
+
+    gn_string_vec_init_n(&vec, 1, 1);
+    gn_string_vec_push(&vec, "ab", 2);
+    gn_string_vec_push(&vec, "", 0);
+    gn_string_vec_push(&vec, "cd", 2);
+    gn_string_vec_push(&vec, "", 0);
+    gn_string_vec_push(&vec, "bcD", 3);
+
+    /* "bc" spans elements 0 and 2 in the arena, only element 4 really holds it */
+    CHECK(gn_string_vec_search_all(&vec, (const int8_t *)"bc", 2, found) == 1 && found[0] == 4);
+    /* matches at the very start and the very end of elements */
+    CHECK(gn_string_vec_search_all(&vec, (const int8_t *)"a", 1, found) == 1 && found[0] == 0);
+    CHECK(gn_string_vec_search_all(&vec, (const int8_t *)"d", 1, found) == 1 && found[0] == 2);
+    CHECK(gn_string_vec_search_all_ci(&vec, (const int8_t *)"D", 1, found) == 2 && found[0] == 2 && found[1] == 4);
+    CHECK(gn_string_vec_search_all(&vec, (const int8_t *)"", 0, found) == 0);
+
+    gn_string_view view = gn_string_vec_get(&vec, 1);
+    CHECK(view._len == 0);
+
+    /* pushing a view of the vector's own element, while the arena has to grow */
+    for (int i = 0; i < 10; ++i)
+    {
+        view = gn_string_vec_get(&vec, gn_string_vec_size(&vec) - 1);
+        gn_string_vec_push(&vec, view._ptr, view._len);
+    }
+    view = gn_string_vec_get(&vec, gn_string_vec_size(&vec) - 1);
+    CHECK(view._len == 3 && !memcmp(view._ptr, "bcD", 3));
+
+    gn_string_vec_free(&vec);
+}
+
+static void check_vec_sort_gather(void)
+{
+    static const char *words[] = {"pear", "", "apple", "app", "pear", "Zebra", "apple"};
+    const size_t count = sizeof(words) / sizeof(words[0]);
+    size_t perm[sizeof(words) / sizeof(words[0])];
+    gn_string_vec vec, sorted;
+
+    gn_string_vec_init(&vec);
+    gn_string_vec_init(&sorted);
+    for (size_t i = 0; i < count; ++i)
+    {
+        gn_string_vec_push(&vec, words[i], strlen(words[i]));
+    }
+
+    gn_string_vec_sort(&vec, perm);
+    /* bytewise, shorter prefix first, equal elements keep their order */
+    static const size_t expect[] = {1, 5, 3, 2, 6, 0, 4};
+    CHECK(!memcmp(perm, expect, sizeof(expect)));
+
+    gn_string_vec_gather(&sorted, &vec, perm, count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        gn_string_view view = gn_string_vec_get(&sorted, i);
+        CHECK(view._len == strlen(words[perm[i]]) && !memcmp(view._ptr, words[perm[i]], view._len));
+    }
+
+    /* gathering a vector into itself appends the reordered copy */
+    gn_string_vec_gather(&vec, &vec, perm, count);
+    CHECK(gn_string_vec_size(&vec) == 2 * count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        gn_string_view view = gn_string_vec_get(&vec, count + i);
+        CHECK(view._len == strlen(words[perm[i]]) && !memcmp(view._ptr, words[perm[i]], view._len));
+    }
+
+    gn_string_vec_free(&vec);
+    gn_string_vec_free(&sorted);
+}
+
+/**
+ * @brief:  overwrite 8 bytes of the serialized form, e.g. an offset
+ */
+static void patch_u64(gn_string *buf, size_t at, uint64_t value)
+{
+    memcpy(&buf->_ptr[at], &value, sizeof(value));
+}
+
+static void check_vec_serialize(void)
+{
+    gn_string_vec vec, loaded;
+    gn_string *buf = NULL;
+
+    gn_string_vec_init(&vec);
+    gn_string_vec_init(&loaded);
+    gn_string_vec_push(&vec, "alpha", 5);
+    gn_string_vec_push(&vec, "", 0);
+    gn_string_vec_push(&vec, "omega", 5);
+
+    gn_string_new(buf);
+    gn_string_vec_serialize(&vec, buf);
+    size_t length = gn_string_len(buf);
+    CHECK(length == GNSTRING_VEC_HEADER + 4 * sizeof(uint64_t) + 10);
+
+    CHECK(gn_string_vec_deserialize(&loaded, buf->_ptr, length) == length);
+    CHECK(gn_string_vec_size(&loaded) == 3);
+    for (size_t i = 0; i < 3; ++i)
+    {
+        gn_string_view a = gn_string_vec_get(&vec, i), b = gn_string_vec_get(&loaded, i);
+        CHECK(a._len == b._len && !memcmp(a._ptr, b._ptr, a._len));
+    }
+
+    /* trailing bytes are left to the caller, a truncated buffer is rejected */
+    CHECK(gn_string_vec_deserialize(&loaded, buf->_ptr, length + 1) == length);
+    for (size_t cut = 0; cut < length; ++cut)
+    {
+        CHECK(gn_string_vec_deserialize(&loaded, buf->_ptr, cut) == 0);
+        CHECK(gn_string_vec_size(&loaded) == 0);
+    }
+
+    const size_t offs = GNSTRING_VEC_HEADER;
+    gn_string *bad = NULL;
+    gn_string_new_n(bad, length + 1);
+
+    /* wrong magic, wrong version, first offset not 0, offsets going back, last offset not the arena size */
+    const size_t at[] = {0, 4, offs, offs + 2 * sizeof(uint64_t), offs + 3 * sizeof(uint64_t)};
+    const uint64_t value[] = {0, 0, 1, 4, 9}; /* the first two are flipped bytes instead */
+    for (size_t i = 0; i < sizeof(at) / sizeof(at[0]); ++i)
+    {
+        gn_string_clear(bad);
+        gn_string_concat(bad, buf);
+        if (i < 2)
+        {
+            bad->_ptr[at[i]] ^= 1;
+        }
+        else
+        {
+            patch_u64(bad, at[i], value[i]);
+        }
+        CHECK(gn_string_vec_deserialize(&loaded, bad->_ptr, length) == 0);
+    }
+
+    /* a count too large for the buffer */
+    gn_string_clear(bad);
+    gn_string_concat(bad, buf);
+    patch_u64(bad, 8, (uint64_t)1 << 60);
+    CHECK(gn_string_vec_deserialize(&loaded, bad->_ptr, length) == 0);
+
+    gn_string_free(bad);
+    gn_string_free(buf);
+    gn_string_vec_free(&vec);
+    gn_string_vec_free(&loaded);
+}
+
+int main(void)
+{
+    srand(20221021);
+
+    check_search_ci_random();
+    check_search_ci_boundaries();
+    check_vec_search_random();
+    check_vec_boundaries();
+    check_vec_sort_gather();
+    check_vec_serialize();
+
+    puts("all checks passed");
+    return 0;
+}